@@ -36,6 +36,10 @@ SensorData currentSensor;
 SystemData currentSystem;
 WiFiData currentWiFi;
 
+// Anomaly report delivered by the last successful upload (shared state)
+AnomalyReport anomalySent;
+bool anomalyAckPending = false;
+
 //=============================================================================
 // FreeRTOS: Task Handles & Synchronization
 //=============================================================================
@@ -43,7 +47,7 @@ TaskHandle_t taskSensorHandle = NULL;
 TaskHandle_t taskDisplayHandle = NULL;
 TaskHandle_t taskNetworkHandle = NULL;
 
-SemaphoreHandle_t dataMutex;  // protect currentSensor/currentSystem/currentWiFi/httpStatus
+SemaphoreHandle_t dataMutex;  // protect currentSensor/currentSystem/currentWiFi/httpStatus/anomalySent
 
 // Forward declarations
 void connectWiFi();
@@ -53,11 +57,17 @@ void sendData();
 void taskSensor(void* pvParameters) {
   (void) pvParameters;
   for (;;) {
-    SensorData sensor = readSensors();
+    RuntimeConfig cfg = configStore.snapshot();
+    SensorData sensor = readSensors(cfg);
     SystemData system = getSystemData();
     WiFiData wifi = getWiFiData();
 
     if (xSemaphoreTake(dataMutex, portMAX_DELAY) == pdTRUE) {
+      // Firings the network task has uploaded leave the report
+      if (anomalyAckPending) {
+        sensor.anomaly = anomalyDetector.acknowledge(anomalySent);
+        anomalyAckPending = false;
+      }
       currentSensor = sensor;
       currentSystem = system;
       currentWiFi = wifi;
@@ -86,7 +96,7 @@ void taskDisplay(void* pvParameters) {
 
     displayHandler.update(sensor, system, wifi, localHttpOK);
     DebugHandler::printSummary(sensor, system, wifi);
-    vTaskDelay(pdMS_TO_TICKS(DISPLAY_UPDATE));
+    vTaskDelay(pdMS_TO_TICKS(configStore.snapshot().displayUpdate));
   }
 }
 
@@ -101,7 +111,7 @@ void taskNetwork(void* pvParameters) {
       // send payload periodically
       static unsigned long lastTx = 0;
       unsigned long now = millis();
-      if (now - lastTx >= SEND_INTERVAL) {
+      if (now - lastTx >= configStore.snapshot().sendInterval) {
         // Prepare safe local copies
         SensorData sensor;
         SystemData system;
@@ -118,16 +128,26 @@ void taskNetwork(void* pvParameters) {
         http.begin(API_ENDPOINT);
         http.addHeader("Content-Type", "application/json");
         http.addHeader("X-Device-Id", DEVICE_ID);
+        http.addHeader("X-Config-Rev", String(configStore.revision()));
         // http.addHeader("X-Api-Key", API_KEY); // Commented out for dev API (no security)
 
         DebugHandler::printJson(payload);
         int code = http.POST(payload);
         bool ok = (code == 200);
         DebugHandler::printHTTP(code);
+
+        // Server may piggyback a newer config on the upload response
+        if (ok && configStore.applyResponse(http.getString())) {
+          debugPrintln("CONFIG UPDATED");
+        }
         http.end();
 
         if (xSemaphoreTake(dataMutex, portMAX_DELAY) == pdTRUE) {
           httpStatus = ok;
+          if (ok && sensor.anomaly.active) {
+            anomalySent = sensor.anomaly;
+            anomalyAckPending = true;
+          }
           xSemaphoreGive(dataMutex);
         }
 
@@ -166,6 +186,12 @@ void setup() {
   // ADD NEW SENSOR INITIALIZATION BELOW:
   //-------------------------------------------------------------------------
   
+  // Runtime config (thresholds, intervals, calibration) from NVS
+  configStore.begin();
+
+  // ZMPT101B/SCT013: restore learned offset & gain from NVS
+  beginCalibration();
+  
   // Example: DHT sensor
   // dht.begin();
   
@@ -181,6 +207,9 @@ void setup() {
   //-------------------------------------------------------------------------
   connectWiFi();
 
+  // NTP clock for hour-of-day anomaly baselines (syncs in background)
+  configTime(NTP_GMT_OFFSET_SEC, 0, NTP_SERVER);
+
   // Init shared state
   currentSensor = SensorData{};
   currentSystem = getSystemData();
@@ -202,6 +231,7 @@ void setup() {
 
 void loop() {
   readPirRealtime();
+  DebugHandler::pollCommands();
   vTaskDelay(pdMS_TO_TICKS(1)); // fast loop for PIR
 }
 
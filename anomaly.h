@@ -0,0 +1,397 @@
+//=============================================================================
+// ESP32 Energy Monitor - Edge Anomaly Detection
+//=============================================================================
+
+#ifndef ANOMALY_H
+#define ANOMALY_H
+
+#include <time.h>
+#include "config.h"
+
+// Defaults for config.h files created before anomaly detection existed
+#ifndef ANOMALY_STEP_MS
+#define ANOMALY_STEP_MS 60000
+#endif
+#ifndef ANOMALY_WARMUP
+#define ANOMALY_WARMUP 60
+#endif
+#ifndef ANOMALY_SLOW_ALPHA
+#define ANOMALY_SLOW_ALPHA 0.0007
+#endif
+#ifndef ANOMALY_CREEP_ALPHA
+#define ANOMALY_CREEP_ALPHA 0.1
+#endif
+#ifndef ANOMALY_CREEP_WARMUP
+#define ANOMALY_CREEP_WARMUP 7
+#endif
+#ifndef ANOMALY_CREEP_MIN_HOURS
+#define ANOMALY_CREEP_MIN_HOURS 18
+#endif
+#ifndef ANOMALY_CREEP_MIN_REL
+#define ANOMALY_CREEP_MIN_REL 0.02
+#endif
+#ifndef ANOMALY_CREEP_H
+#define ANOMALY_CREEP_H 5.0
+#endif
+#ifndef ANOMALY_FAST_MS
+#define ANOMALY_FAST_MS 5000
+#endif
+#ifndef ANOMALY_LEVEL_MS
+#define ANOMALY_LEVEL_MS 1800000
+#endif
+#ifndef ANOMALY_SPREAD_MS
+#define ANOMALY_SPREAD_MS 86400000
+#endif
+#ifndef ANOMALY_SIGNATURE_WARMUP_MS
+#define ANOMALY_SIGNATURE_WARMUP_MS 3600000
+#endif
+#ifndef ANOMALY_SIGNATURE_MS
+#define ANOMALY_SIGNATURE_MS 600000
+#endif
+#ifndef ANOMALY_MIN_STDDEV
+#define ANOMALY_MIN_STDDEV 0.01
+#endif
+#ifndef ANOMALY_CUSUM_K
+#define ANOMALY_CUSUM_K 0.5
+#endif
+#ifndef ANOMALY_CUSUM_H
+#define ANOMALY_CUSUM_H 15.0
+#endif
+#ifndef ANOMALY_Z_LIMIT
+#define ANOMALY_Z_LIMIT 5.0
+#endif
+#ifndef ANOMALY_SEASONAL_ALPHA
+#define ANOMALY_SEASONAL_ALPHA 0.2
+#endif
+#ifndef ANOMALY_SEASONAL_WARMUP
+#define ANOMALY_SEASONAL_WARMUP 3
+#endif
+#ifndef ANOMALY_SEASONAL_MIN_SAMPLES
+#define ANOMALY_SEASONAL_MIN_SAMPLES 100
+#endif
+#ifndef ANOMALY_SEASONAL_MIN_REL
+#define ANOMALY_SEASONAL_MIN_REL 0.1
+#endif
+#ifndef ANOMALY_SEASONAL_Z_LIMIT
+#define ANOMALY_SEASONAL_Z_LIMIT 4.0
+#endif
+#ifndef ANOMALY_CYCLE_BUDGET
+#define ANOMALY_CYCLE_BUDGET 20000
+#endif
+#ifndef NTP_SERVER
+#define NTP_SERVER "pool.ntp.org"
+#endif
+#ifndef NTP_GMT_OFFSET_SEC
+#define NTP_GMT_OFFSET_SEC 25200
+#endif
+
+//=============================================================================
+// ANOMALY TYPES
+//=============================================================================
+
+enum AnomalyType : uint8_t {
+  ANOMALY_LOAD_CREEP = 0,     // daily power drifting up vs previous days (CUSUM)
+  ANOMALY_SIGNATURE,          // power level shift that persists (z-score)
+  ANOMALY_VOLTAGE_SAG,        // voltage sagging below its baseline (CUSUM)
+  ANOMALY_SEASONAL,           // hourly power unusual compared to previous days
+  ANOMALY_TYPE_COUNT
+};
+
+inline const char* anomalyName(uint8_t type) {
+  switch (type) {
+    case ANOMALY_LOAD_CREEP:  return "load_creep";
+    case ANOMALY_SIGNATURE:   return "signature_change";
+    case ANOMALY_VOLTAGE_SAG: return "voltage_sag";
+    case ANOMALY_SEASONAL:    return "seasonal_deviation";
+    default:                  return "unknown";
+  }
+}
+
+struct AnomalyReport {
+  uint8_t active;                     // bit (1 << AnomalyType) until delivered
+  float score[ANOMALY_TYPE_COUNT];    // peak score until delivered, >= 1.0 fired
+  uint32_t seq;                       // bumped on every firing
+  uint32_t cycles;                    // CPU cycles spent on the last sample
+  uint32_t maxCycles;                 // worst case since boot
+  uint32_t overruns;                  // samples over ANOMALY_CYCLE_BUDGET
+};
+
+//=============================================================================
+// INCREMENTAL STATISTICS
+//=============================================================================
+
+// Exponentially weighted mean and variance, O(1) memory
+struct EwmaStats {
+  float mean;
+  float var;
+  uint32_t count;             // updates seen, saturates
+
+  void update(float x, float alpha) {
+    if (count == 0) {
+      mean = x;
+      var = 0;
+    } else {
+      // Plain running average until the EWMA window is filled
+      float a = 1.0f / (count + 1);
+      if (a < alpha) a = alpha;
+      float d = x - mean;
+      mean += a * d;
+      var = (1.0f - a) * (var + a * d * d);
+    }
+    if (count < 0xFFFFFFFF) count++;
+  }
+
+  float stddev() const { return sqrtf(var); }
+
+  float zScore(float x) const {
+    float sd = stddev();
+    return sd > ANOMALY_MIN_STDDEV ? (x - mean) / sd : 0;
+  }
+};
+
+// Plain mean over one aggregation period (a step or an hour)
+struct RunningMean {
+  float mean;
+  uint32_t count;
+
+  void add(float x) {
+    count++;
+    mean += (x - mean) / count;
+  }
+
+  void reset() {
+    mean = 0;
+    count = 0;
+  }
+};
+
+// EWMA weight for a sample dt ms after the previous one, so time constants
+// hold whatever the sample period (runtime `samples` setting)
+inline float timeAlpha(unsigned long dt, unsigned long tau) {
+  float alpha = (float)dt / tau;
+  return alpha < 1 ? alpha : 1;
+}
+
+// Two-sided CUSUM on standardized residuals
+struct Cusum {
+  float high;
+  float low;
+
+  void update(float z) {
+    high = fmaxf(0, high + z - ANOMALY_CUSUM_K);
+    low = fmaxf(0, low - z - ANOMALY_CUSUM_K);
+  }
+};
+
+//=============================================================================
+// ANOMALY DETECTOR
+//=============================================================================
+// Constant work per sample. Three time scales:
+// - per sample: signature change, the recent power level (ANOMALY_FAST_MS)
+//               away from its baseline (ANOMALY_LEVEL_MS) by more than
+//               ANOMALY_Z_LIMIT for ANOMALY_SIGNATURE_MS. Shorter runs (a
+//               kettle, a fridge start) stay out of the baseline and spread.
+//               Weights scale with the time between samples.
+// - per step:   voltage sag, CUSUM of step means (ANOMALY_STEP_MS) against a
+//               baseline that moves once per step (~1/ANOMALY_SLOW_ALPHA steps)
+// - per hour:   each hour's mean power against the same hour on previous
+//               weekdays or weekend days (seasonal)
+// - per day:    creep, CUSUM of the day's mean relative residual to those
+//               hourly baselines. Whole days are compared because normal
+//               day-to-day variation moves every hour of a day together; the
+//               daily and weekly load cycles are not mistaken for creep.
+// Creep and seasonal checks need the clock (NTP). A firing stays in the
+// report, with its peak score, until acknowledge() confirms it was uploaded.
+
+inline uint32_t cpuCycles() { return ESP.getCycleCount(); }
+
+// Hour of day x day type: slot = hour + 24 on Saturday/Sunday
+#define ANOMALY_SLOTS 48
+
+class AnomalyDetector {
+private:
+  uint32_t (*cycleCounter)();
+
+  EwmaStats powerFast;        // per sample, recent level
+  EwmaStats powerLevel;       // per sample, baseline level
+  EwmaStats levelSpread;      // per sample, recent minus baseline level
+  unsigned long firstSample;
+  unsigned long lastSample;
+  bool sampled;
+  unsigned long deviationStart;
+  bool deviating;             // recent level beyond ANOMALY_Z_LIMIT
+  bool deviationReported;
+
+  RunningMean voltageStep;
+  unsigned long stepStart;
+  EwmaStats voltageBaseline;  // per step, voltage
+  Cusum voltageCusum;
+
+  EwmaStats hourly[ANOMALY_SLOTS];  // per day, mean power of that slot
+  RunningMean hourMean;
+  int8_t aggSlot;             // slot being aggregated, -1 = none yet
+  bool aggComplete;           // aggregation started at the top of the hour
+  RunningMean dayResidual;    // relative residual of today's hours
+  EwmaStats creepBaseline;    // per day, mean relative residual
+  Cusum powerCusum;
+
+  uint32_t firedSeq[ANOMALY_TYPE_COUNT];  // report.seq of the last firing per type
+  AnomalyReport report;
+
+  void fire(uint8_t type, float score) {
+    if (score < 1.0) return;
+    if (!(report.active & (1 << type)) || score > report.score[type]) {
+      report.score[type] = score;
+    }
+    report.active |= (1 << type);
+    firedSeq[type] = ++report.seq;
+  }
+
+  void closeStep() {
+    if (voltageBaseline.count >= ANOMALY_WARMUP) {
+      // Voltage sag: only the downward side of the CUSUM matters
+      voltageCusum.update(voltageBaseline.zScore(voltageStep.mean));
+      fire(ANOMALY_VOLTAGE_SAG, voltageCusum.low / ANOMALY_CUSUM_H);
+      if (voltageCusum.low > ANOMALY_CUSUM_H) voltageCusum.low = 0;
+    }
+    voltageBaseline.update(voltageStep.mean, ANOMALY_SLOW_ALPHA);
+    voltageStep.reset();
+  }
+
+  void updateSignature(float power, unsigned long now) {
+    unsigned long dt = sampled ? now - lastSample : 0;
+    if (!sampled) firstSample = now;
+    sampled = true;
+    lastSample = now;
+
+    powerFast.update(power, timeAlpha(dt, ANOMALY_FAST_MS));
+    if (powerLevel.count == 0) {
+      powerLevel.update(powerFast.mean, 1);
+      return;
+    }
+    float deviation = powerFast.mean - powerLevel.mean;
+
+    if (now - firstSample >= ANOMALY_SIGNATURE_WARMUP_MS) {
+      float z = fabsf(levelSpread.zScore(deviation));
+      if (z > ANOMALY_Z_LIMIT) {
+        if (!deviating) {
+          deviating = true;
+          deviationStart = now;
+          deviationReported = false;
+        }
+        if (!deviationReported && now - deviationStart >= ANOMALY_SIGNATURE_MS) {
+          fire(ANOMALY_SIGNATURE, z / ANOMALY_Z_LIMIT);
+          deviationReported = true;
+        }
+      } else {
+        deviating = false;
+      }
+    }
+
+    // A reported shift is the new normal and gets learned
+    if (!deviating || deviationReported) {
+      levelSpread.update(deviation, timeAlpha(dt, ANOMALY_SPREAD_MS));
+      powerLevel.update(power, timeAlpha(dt, ANOMALY_LEVEL_MS));
+    }
+  }
+
+  void closeDay() {
+    if (dayResidual.count >= ANOMALY_CREEP_MIN_HOURS) {
+      if (creepBaseline.count >= ANOMALY_CREEP_WARMUP) {
+        // Gradual load creep: only the upward side of the CUSUM matters.
+        // Floor the spread: a few near-identical days would flag any change.
+        float sd = fmaxf(creepBaseline.stddev(), ANOMALY_CREEP_MIN_REL);
+        powerCusum.update((dayResidual.mean - creepBaseline.mean) / sd);
+        fire(ANOMALY_LOAD_CREEP, powerCusum.high / ANOMALY_CREEP_H);
+        if (powerCusum.high > ANOMALY_CREEP_H) powerCusum.high = 0;
+      }
+      creepBaseline.update(dayResidual.mean, ANOMALY_CREEP_ALPHA);
+    }
+    dayResidual.reset();
+  }
+
+  void closeHour(int8_t nextSlot) {
+    if (aggSlot >= 0 && aggComplete && hourMean.count >= ANOMALY_SEASONAL_MIN_SAMPLES) {
+      EwmaStats& bucket = hourly[aggSlot];
+
+      if (bucket.count >= ANOMALY_SEASONAL_WARMUP) {
+        if (fabsf(bucket.mean) > ANOMALY_MIN_STDDEV) {
+          dayResidual.add((hourMean.mean - bucket.mean) / fabsf(bucket.mean));
+        }
+
+        // Floor the spread: a few near-identical days would flag any change
+        float sd = fmaxf(bucket.stddev(), fabsf(bucket.mean) * ANOMALY_SEASONAL_MIN_REL);
+        if (sd > ANOMALY_MIN_STDDEV) {
+          fire(ANOMALY_SEASONAL, fabsf(hourMean.mean - bucket.mean) / sd / ANOMALY_SEASONAL_Z_LIMIT);
+        }
+      }
+      bucket.update(hourMean.mean, ANOMALY_SEASONAL_ALPHA);
+    }
+    if (aggSlot >= 0 && nextSlot % 24 == 0) closeDay();
+
+    // The first hour seen after boot or clock sync is partial
+    aggComplete = aggSlot >= 0;
+    aggSlot = nextSlot;
+    hourMean.reset();
+  }
+
+public:
+  AnomalyDetector(uint32_t (*cycleCounter)() = cpuCycles)
+    : cycleCounter(cycleCounter), powerFast{}, powerLevel{}, levelSpread{},
+      firstSample(0), lastSample(0), sampled(false),
+      deviationStart(0), deviating(false), deviationReported(false),
+      voltageStep{}, stepStart(0), voltageBaseline{}, voltageCusum{},
+      hourly{}, hourMean{}, aggSlot(-1), aggComplete(false),
+      dayResidual{}, creepBaseline{}, powerCusum{}, firedSeq{}, report{} {}
+
+  // Feed one sample; slot is 0..ANOMALY_SLOTS-1 (see currentSlot) or -1
+  // when the clock is not set yet
+  const AnomalyReport& update(float voltage, float current, int slot, unsigned long now) {
+    uint32_t start = cycleCounter();
+    float power = voltage * current;
+
+    updateSignature(power, now);
+
+    if (slot >= 0 && slot < ANOMALY_SLOTS) {
+      if (slot != aggSlot) closeHour(slot);
+      hourMean.add(power);
+    }
+
+    if (voltageStep.count == 0) stepStart = now;
+    voltageStep.add(voltage);
+    if (now - stepStart >= ANOMALY_STEP_MS) closeStep();
+
+    report.cycles = cycleCounter() - start;
+    if (report.cycles > report.maxCycles) report.maxCycles = report.cycles;
+    if (report.cycles > ANOMALY_CYCLE_BUDGET) report.overruns++;
+    return report;
+  }
+
+  const AnomalyReport& getReport() const { return report; }
+
+  // `sent` was uploaded: clear the firings it carried. A type that fired
+  // again after `sent` was taken stays set for the next upload.
+  const AnomalyReport& acknowledge(const AnomalyReport& sent) {
+    for (uint8_t type = 0; type < ANOMALY_TYPE_COUNT; type++) {
+      if ((sent.active & (1 << type)) && firedSeq[type] <= sent.seq) {
+        report.active &= ~(1 << type);
+        report.score[type] = 0;
+      }
+    }
+    return report;
+  }
+};
+
+static AnomalyDetector anomalyDetector;
+
+// Local hour of day, +24 on Saturday/Sunday, or -1 until NTP has set the clock
+int currentSlot() {
+  time_t now = time(nullptr);
+  if (now < 1600000000) return -1;
+  struct tm local;
+  localtime_r(&now, &local);
+  bool weekend = local.tm_wday == 0 || local.tm_wday == 6;
+  return local.tm_hour + (weekend ? 24 : 0);
+}
+
+#endif
@@ -0,0 +1,281 @@
+//=============================================================================
+// ESP32 Energy Monitor - Analog Sensor Calibration & Fault Detection
+//=============================================================================
+
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <atomic>
+#include <Preferences.h>
+#include "config.h"
+
+// Defaults for config.h files created before runtime calibration existed
+#ifndef CALIB_NVS_NAMESPACE
+#define CALIB_NVS_NAMESPACE "calib"
+#endif
+#ifndef CALIB_WARMUP_WINDOWS
+#define CALIB_WARMUP_WINDOWS 20
+#endif
+#ifndef CALIB_OFFSET_ALPHA
+#define CALIB_OFFSET_ALPHA 0.01
+#endif
+#ifndef CALIB_NOISE_ALPHA
+#define CALIB_NOISE_ALPHA 0.05
+#endif
+#ifndef CALIB_NOISE_MARGIN
+#define CALIB_NOISE_MARGIN 1.5
+#endif
+#ifndef CALIB_DRIFT_LIMIT
+#define CALIB_DRIFT_LIMIT 250
+#endif
+#ifndef CALIB_RAIL_MARGIN
+#define CALIB_RAIL_MARGIN 50
+#endif
+#ifndef CALIB_STUCK_WINDOWS
+#define CALIB_STUCK_WINDOWS 5
+#endif
+#ifndef CALIB_SAVE_INTERVAL
+#define CALIB_SAVE_INTERVAL 600000
+#endif
+#ifndef CALIB_SAVE_DELTA
+#define CALIB_SAVE_DELTA 5.0
+#endif
+#ifndef CALIB_GAIN_SAVE_DELTA
+#define CALIB_GAIN_SAVE_DELTA 0.002
+#endif
+#ifndef CALIB_GAIN_LIMIT
+#define CALIB_GAIN_LIMIT 0.10
+#endif
+
+//=============================================================================
+// CHANNEL QUALITY
+//=============================================================================
+
+// Fault bits reported per analog channel
+enum ChannelFault : uint8_t {
+  FAULT_NONE         = 0,
+  FAULT_CLIPPING     = 1 << 0,  // samples hit ADC 0 or 4095
+  FAULT_STUCK        = 1 << 1,  // no variation at all for several windows
+  FAULT_DISCONNECTED = 1 << 2,  // input parked at a rail with no signal
+  FAULT_OFFSET_DRIFT = 1 << 3,  // DC bias far away from mid-scale
+  FAULT_NOISY        = 1 << 4,  // idle noise within CALIB_NOISE_MARGIN of the threshold
+};
+
+// Faults that make the reading itself unusable
+#define FAULT_CRITICAL (FAULT_STUCK | FAULT_DISCONNECTED)
+
+struct ChannelQuality {
+  uint8_t faults;             // ChannelFault bits
+  bool calibrated;            // offset learned (or restored) and in range
+  float offset;               // DC bias in ADC counts
+  float noiseFloor;           // idle peak-to-peak in ADC counts
+  float gain;                 // runtime gain on top of *_CALIBRATION
+};
+
+// Statistics collected while sampling one window
+struct WindowStats {
+  long sum;
+  int min;
+  int max;
+  int clipped;                // samples at ADC 0 or 4095
+  int samples;
+};
+
+inline const char* faultName(uint8_t fault) {
+  switch (fault) {
+    case FAULT_CLIPPING:     return "adc_clipping";
+    case FAULT_STUCK:        return "stuck_value";
+    case FAULT_DISCONNECTED: return "disconnected";
+    case FAULT_OFFSET_DRIFT: return "offset_drift";
+    case FAULT_NOISY:        return "high_noise";
+    default:                 return "unknown";
+  }
+}
+
+//=============================================================================
+// CHANNEL CALIBRATOR
+//=============================================================================
+// Tracks DC offset, noise floor, clipping and stuck-at values with running
+// averages only (no sample history). Offset and gain are kept in NVS so a
+// reboot does not need a new warm-up. Gain only changes on an explicit
+// request against a reference meter, never from the readings themselves.
+
+class ChannelCalibrator {
+private:
+  const char* offsetKey;
+  const char* gainKey;
+  int threshold;
+
+  float offset;
+  float gain;
+  float noiseFloor;
+  float savedOffset;
+  float savedGain;
+  uint16_t windows;           // usable windows seen, saturates at warm-up
+  uint8_t stuckWindows;
+  unsigned long lastSave;
+  bool saveNow;               // skip the rate limit once (explicit calibration)
+  std::atomic<float> pendingReference;  // reference value to calibrate against, 0 = none
+  ChannelQuality quality;
+
+  static float nominalOffset() {
+    return DC_OFFSET / ADC_REF_VOLTAGE * ADC_RESOLUTION;
+  }
+
+public:
+  ChannelCalibrator(const char* offsetKey, const char* gainKey, int threshold)
+    : offsetKey(offsetKey), gainKey(gainKey), threshold(threshold),
+      offset(nominalOffset()), gain(1.0), noiseFloor(0),
+      savedOffset(NAN), savedGain(NAN), windows(0), stuckWindows(0),
+      lastSave(0), saveNow(false), pendingReference(0), quality{} {
+    quality.offset = offset;
+    quality.gain = gain;
+  }
+
+  // Restore offset and gain from NVS (call once from setup)
+  void begin() {
+    Preferences prefs;
+    if (!prefs.begin(CALIB_NVS_NAMESPACE, true)) return;
+    float storedOffset = prefs.getFloat(offsetKey, NAN);
+    float storedGain = prefs.getFloat(gainKey, NAN);
+    prefs.end();
+
+    if (!isnan(storedOffset) && storedOffset > CALIB_RAIL_MARGIN &&
+        storedOffset < ADC_RESOLUTION - CALIB_RAIL_MARGIN) {
+      offset = storedOffset;
+      savedOffset = storedOffset;
+      windows = CALIB_WARMUP_WINDOWS;  // trust the stored value
+    }
+    if (!isnan(storedGain) && fabs(storedGain - 1.0) <= CALIB_GAIN_LIMIT) {
+      gain = storedGain;
+      savedGain = storedGain;
+    }
+    quality.offset = offset;
+    quality.gain = gain;
+  }
+
+  // Classify one sampling window and update the running estimates
+  const ChannelQuality& update(const WindowStats& w) {
+    float mean = (float)w.sum / w.samples;
+    int peakToPeak = w.max - w.min;
+    uint8_t faults = FAULT_NONE;
+
+    bool atRail = mean <= CALIB_RAIL_MARGIN || mean >= ADC_RESOLUTION - CALIB_RAIL_MARGIN;
+    if (atRail && peakToPeak < threshold) {
+      faults |= FAULT_DISCONNECTED;
+    } else if (w.clipped > 0) {
+      faults |= FAULT_CLIPPING;
+    }
+
+    if (peakToPeak == 0) {
+      if (stuckWindows < 255) stuckWindows++;
+    } else {
+      stuckWindows = 0;
+    }
+    if (stuckWindows >= CALIB_STUCK_WINDOWS && !(faults & FAULT_DISCONNECTED)) {
+      faults |= FAULT_STUCK;
+    }
+
+    // Only learn from windows that reflect the real bias
+    if (!(faults & (FAULT_CRITICAL | FAULT_CLIPPING))) {
+      // Plain mean during warm-up, slow EWMA afterwards
+      float alpha = windows < CALIB_WARMUP_WINDOWS ? 1.0 / (windows + 1) : CALIB_OFFSET_ALPHA;
+      offset += alpha * (mean - offset);
+      if (windows < CALIB_WARMUP_WINDOWS) windows++;
+
+      // Noise floor only from idle windows: a steady small load above the
+      // threshold is a reading, not noise
+      if (peakToPeak <= threshold) {
+        noiseFloor += CALIB_NOISE_ALPHA * (peakToPeak - noiseFloor);
+      }
+    }
+
+    if (fabs(offset - nominalOffset()) > CALIB_DRIFT_LIMIT) faults |= FAULT_OFFSET_DRIFT;
+    if (noiseFloor * CALIB_NOISE_MARGIN > threshold) faults |= FAULT_NOISY;
+
+    quality.faults = faults;
+    quality.calibrated = windows >= CALIB_WARMUP_WINDOWS &&
+                         !(faults & (FAULT_CRITICAL | FAULT_OFFSET_DRIFT));
+    quality.offset = offset;
+    quality.noiseFloor = noiseFloor;
+    quality.gain = gain;
+    return quality;
+  }
+
+  // Peak-to-peak in ADC counts. When a window clips, rebuild it from the
+  // unclipped half-swing around the learned offset.
+  float peakToPeak(const WindowStats& w) const {
+    if (!(quality.faults & FAULT_CLIPPING)) return w.max - w.min;
+    float up = w.max - offset;
+    float down = offset - w.min;
+    float half = up > down ? up : down;
+    return half > 0 ? 2.0 * half : 0;
+  }
+
+  // Channel carries a signal above both the fixed threshold and the noise floor
+  bool isActive(const WindowStats& w) const {
+    if (quality.faults & FAULT_CRITICAL) return false;
+    int peakToPeak = w.max - w.min;
+    return peakToPeak > threshold && peakToPeak > noiseFloor * CALIB_NOISE_MARGIN;
+  }
+
+  float getGain() const { return gain; }
+
+  void setThreshold(int value) { threshold = value; }
+
+  // Ask for a one-shot gain calibration against a reference meter reading
+  // (safe to call from another task; applied on the next healthy window)
+  void requestGainCalibration(float reference) {
+    pendingReference.store(reference);
+  }
+
+  // Apply a pending calibration to this window's reading. Returns true when
+  // the gain changed. Requests outside +/-CALIB_GAIN_LIMIT are dropped.
+  bool applyGainCalibration(float measured) {
+    if (pendingReference.load() <= 0) return false;
+    if (!quality.calibrated || quality.faults != FAULT_NONE || measured <= 0) return false;
+    // Take the request atomically so one arriving meanwhile is not lost
+    float reference = pendingReference.exchange(0);
+    if (reference <= 0) return false;
+
+    float next = gain * reference / measured;
+    if (fabs(next - 1.0) > CALIB_GAIN_LIMIT) return false;
+    gain = next;
+    quality.gain = gain;
+    saveNow = true;
+    return true;
+  }
+
+  // Write offset/gain to NVS when they moved enough (rate limited for flash wear)
+  void persist() {
+    if (!quality.calibrated) return;
+    unsigned long now = millis();
+    if (!saveNow && lastSave != 0 && now - lastSave < CALIB_SAVE_INTERVAL) return;
+
+    bool offsetMoved = isnan(savedOffset) || fabs(offset - savedOffset) >= CALIB_SAVE_DELTA;
+    bool gainMoved = isnan(savedGain) || fabs(gain - savedGain) >= CALIB_GAIN_SAVE_DELTA;
+    if (!offsetMoved && !gainMoved) return;
+
+    Preferences prefs;
+    if (!prefs.begin(CALIB_NVS_NAMESPACE, false)) return;
+    prefs.putFloat(offsetKey, offset);
+    prefs.putFloat(gainKey, gain);
+    prefs.end();
+
+    savedOffset = offset;
+    savedGain = gain;
+    lastSave = now;
+    saveNow = false;
+  }
+};
+
+// One calibrator per analog channel (NVS keys max 15 chars)
+static ChannelCalibrator zmptCalibrator("zmpt_off", "zmpt_gain", ZMPT_THRESHOLD);
+static ChannelCalibrator sctCalibrator("sct_off", "sct_gain", SCT_THRESHOLD);
+
+void beginCalibration() {
+  zmptCalibrator.begin();
+  sctCalibrator.begin();
+}
+
+#endif
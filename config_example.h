@@ -177,4 +177,126 @@
 #define DC_OFFSET 1.65
 #endif
 
+// Runtime config store (server-pushed values override the defaults above)
+#ifndef CONFIG_NVS_NAMESPACE
+#define CONFIG_NVS_NAMESPACE "cfg"
+#endif
+
+// Runtime calibration & fault detection (ZMPT101B / SCT013)
+#ifndef CALIB_NVS_NAMESPACE
+#define CALIB_NVS_NAMESPACE "calib"
+#endif
+#ifndef CALIB_WARMUP_WINDOWS
+#define CALIB_WARMUP_WINDOWS 20       // Windows averaged before offset is trusted
+#endif
+#ifndef CALIB_OFFSET_ALPHA
+#define CALIB_OFFSET_ALPHA 0.01       // EWMA weight for DC offset after warm-up
+#endif
+#ifndef CALIB_NOISE_ALPHA
+#define CALIB_NOISE_ALPHA 0.05        // EWMA weight for idle (<= threshold) noise floor
+#endif
+#ifndef CALIB_NOISE_MARGIN
+#define CALIB_NOISE_MARGIN 1.5        // Signal must exceed noise floor * margin to be active
+#endif
+#ifndef CALIB_DRIFT_LIMIT
+#define CALIB_DRIFT_LIMIT 250         // Max offset distance from mid-scale (ADC counts)
+#endif
+#ifndef CALIB_RAIL_MARGIN
+#define CALIB_RAIL_MARGIN 50          // Mean this close to 0/4095 counts as a rail
+#endif
+#ifndef CALIB_STUCK_WINDOWS
+#define CALIB_STUCK_WINDOWS 5         // Flat windows in a row before stuck_value
+#endif
+#ifndef CALIB_SAVE_INTERVAL
+#define CALIB_SAVE_INTERVAL 600000    // Min time between NVS writes (milliseconds)
+#endif
+#ifndef CALIB_SAVE_DELTA
+#define CALIB_SAVE_DELTA 5.0          // Offset change that triggers a save (ADC counts)
+#endif
+#ifndef CALIB_GAIN_SAVE_DELTA
+#define CALIB_GAIN_SAVE_DELTA 0.002   // Gain change that triggers a save
+#endif
+#ifndef CALIB_GAIN_LIMIT
+#define CALIB_GAIN_LIMIT 0.10         // Reference calibration may move gain 1.0 +/- limit
+#endif
+
+// Edge anomaly detection (voltage/current/power streams)
+#ifndef ANOMALY_STEP_MS
+#define ANOMALY_STEP_MS 60000         // Step for the voltage sag baseline (milliseconds)
+#endif
+#ifndef ANOMALY_WARMUP
+#define ANOMALY_WARMUP 60             // Steps before step baselines are scored
+#endif
+#ifndef ANOMALY_SLOW_ALPHA
+#define ANOMALY_SLOW_ALPHA 0.0007     // EWMA weight per step (~1 day with 1 min steps)
+#endif
+#ifndef ANOMALY_CREEP_ALPHA
+#define ANOMALY_CREEP_ALPHA 0.1       // EWMA weight per day for daily creep residuals (~10 days)
+#endif
+#ifndef ANOMALY_CREEP_WARMUP
+#define ANOMALY_CREEP_WARMUP 7        // Days of residuals before creep is scored
+#endif
+#ifndef ANOMALY_CREEP_MIN_HOURS
+#define ANOMALY_CREEP_MIN_HOURS 18    // Scored hours for a day to count
+#endif
+#ifndef ANOMALY_CREEP_MIN_REL
+#define ANOMALY_CREEP_MIN_REL 0.02    // Spread floor for daily residuals (fraction)
+#endif
+#ifndef ANOMALY_CREEP_H
+#define ANOMALY_CREEP_H 5.0           // Creep CUSUM decision limit
+#endif
+#ifndef ANOMALY_FAST_MS
+#define ANOMALY_FAST_MS 5000          // Time constant of the recent power level (milliseconds)
+#endif
+#ifndef ANOMALY_LEVEL_MS
+#define ANOMALY_LEVEL_MS 1800000      // Time constant of the baseline power level (milliseconds)
+#endif
+#ifndef ANOMALY_SPREAD_MS
+#define ANOMALY_SPREAD_MS 86400000    // Time constant of the level spread (milliseconds)
+#endif
+#ifndef ANOMALY_SIGNATURE_WARMUP_MS
+#define ANOMALY_SIGNATURE_WARMUP_MS 3600000  // Learning time before signature change is scored
+#endif
+#ifndef ANOMALY_SIGNATURE_MS
+#define ANOMALY_SIGNATURE_MS 600000   // A level shift must last this long to be reported
+#endif
+#ifndef ANOMALY_MIN_STDDEV
+#define ANOMALY_MIN_STDDEV 0.01       // Ignore z-scores on flat signals
+#endif
+#ifndef ANOMALY_CUSUM_K
+#define ANOMALY_CUSUM_K 0.5           // CUSUM slack (standard deviations)
+#endif
+#ifndef ANOMALY_CUSUM_H
+#define ANOMALY_CUSUM_H 15.0          // Voltage sag CUSUM decision limit
+#endif
+#ifndef ANOMALY_Z_LIMIT
+#define ANOMALY_Z_LIMIT 5.0           // |z| of a level shift that counts as a signature change
+#endif
+#ifndef ANOMALY_SEASONAL_ALPHA
+#define ANOMALY_SEASONAL_ALPHA 0.2    // EWMA weight per day for weekday/weekend hour baselines
+#endif
+#ifndef ANOMALY_SEASONAL_WARMUP
+#define ANOMALY_SEASONAL_WARMUP 3     // Days of history before an hour is scored
+#endif
+#ifndef ANOMALY_SEASONAL_MIN_SAMPLES
+#define ANOMALY_SEASONAL_MIN_SAMPLES 100  // Samples for an hour to count
+#endif
+#ifndef ANOMALY_SEASONAL_MIN_REL
+#define ANOMALY_SEASONAL_MIN_REL 0.1 // Spread floor as a fraction of the hourly mean
+#endif
+#ifndef ANOMALY_SEASONAL_Z_LIMIT
+#define ANOMALY_SEASONAL_Z_LIMIT 4.0  // |z| against the same hour on previous days
+#endif
+#ifndef ANOMALY_CYCLE_BUDGET
+#define ANOMALY_CYCLE_BUDGET 20000    // CPU cycles allowed per sample (~83us @240MHz)
+#endif
+
+// NTP (needed for hour-of-day baselines)
+#ifndef NTP_SERVER
+#define NTP_SERVER "pool.ntp.org"
+#endif
+#ifndef NTP_GMT_OFFSET_SEC
+#define NTP_GMT_OFFSET_SEC 25200      // WIB (UTC+7)
+#endif
+
 #endif //
@@ -8,6 +8,9 @@
 #include <ArduinoJson.h>
 #include <WiFi.h>
 #include "config.h"
+#include "calibration.h"
+#include "anomaly.h"
+#include "runtime_config.h"
 
 // Add DHT library
 #include <DHT.h>
@@ -27,11 +30,13 @@ struct SensorData {
   int zmptRaw;
   float voltage;              // Calculated voltage
   bool zmptActive;
+  ChannelQuality zmptQuality; // Offset/noise/fault tracking
   
   // SCT013 Current Sensor  
   int sctRaw;
   float current;              // Calculated current
   bool sctActive;
+  ChannelQuality sctQuality;  // Offset/noise/fault tracking
   
   // ADD NEW SENSOR FIELDS BELOW:
   // Example: float temperature;
@@ -49,6 +54,9 @@ struct SensorData {
   bool currentOverlimit;      // current > CURRENT_MAX
   bool tempOutOfRange;        // temperature outside TEMP_LOW..TEMP_HIGH
   bool humOutOfRange;         // humidity outside HUM_LOW..HUM_HIGH
+
+  // Edge anomaly detection (voltage/current/power)
+  AnomalyReport anomaly;
 };
 
 // System data struct  
@@ -83,6 +91,17 @@ class DataHandler {
 private:
   JsonDocument doc;
 
+  static const char* channelStatus(const ChannelQuality& quality, bool active) {
+    if (quality.faults & FAULT_CRITICAL) return "error";
+    return active ? "ok" : "inactive";
+  }
+
+  static void addChannelErrors(JsonArray errors, uint8_t faults) {
+    for (uint8_t bit = 1; bit != 0; bit <<= 1) {
+      if (faults & bit) errors.add(faultName(bit));
+    }
+  }
+
 public:
   DataHandler() {
     doc.to<JsonObject>();
@@ -158,9 +177,10 @@ public:
     zmptObs["voltage_v"] = sensor.voltage;
 
     JsonObject zmptQuality = zmpt["quality"].to<JsonObject>();
-    zmptQuality["status"] = sensor.zmptActive ? "ok" : "inactive";
-    zmptQuality["calibrated"] = true;
+    zmptQuality["status"] = channelStatus(sensor.zmptQuality, sensor.zmptActive);
+    zmptQuality["calibrated"] = sensor.zmptQuality.calibrated;
     JsonArray zmptErrors = zmptQuality["errors"].to<JsonArray>();
+    addChannelErrors(zmptErrors, sensor.zmptQuality.faults);
     zmptQuality["notes"] = "AC voltage sensor ZMPT101B for electrical monitoring.";
 
     // SCT013 Current Sensor
@@ -174,9 +194,10 @@ public:
     sctObs["current_a"] = sensor.current;
 
     JsonObject sctQuality = sct["quality"].to<JsonObject>();
-    sctQuality["status"] = sensor.sctActive ? "ok" : "inactive";
-    sctQuality["calibrated"] = true;
+    sctQuality["status"] = channelStatus(sensor.sctQuality, sensor.sctActive);
+    sctQuality["calibrated"] = sensor.sctQuality.calibrated;
     JsonArray sctErrors = sctQuality["errors"].to<JsonArray>();
+    addChannelErrors(sctErrors, sensor.sctQuality.faults);
     sctQuality["notes"] = "AC current sensor SCT013 for electrical load monitoring.";
 
     // PIR Motion Sensor
@@ -216,6 +237,20 @@ public:
     }
     dhtQuality["notes"] = "DHT22 sensor for room temperature and humidity monitoring.";
 
+    // Anomalies (present until a successful upload has delivered them)
+    if (sensor.anomaly.active) {
+      JsonObject anomaly = doc["anomaly"].to<JsonObject>();
+      JsonObject scores = anomaly["scores"].to<JsonObject>();
+      for (uint8_t type = 0; type < ANOMALY_TYPE_COUNT; type++) {
+        if (sensor.anomaly.active & (1 << type)) {
+          scores[anomalyName(type)] = sensor.anomaly.score[type];
+        }
+      }
+      anomaly["cycles"] = sensor.anomaly.cycles;
+      anomaly["max_cycles"] = sensor.anomaly.maxCycles;
+      anomaly["overruns"] = sensor.anomaly.overruns;
+    }
+
     String output;
     serializeJson(doc, output);
     return output;
@@ -227,68 +262,92 @@ public:
 //=============================================================================
 
 // Helper functions for data collection
-SensorData readSensors() {
+// cfg is one snapshot for the whole reading, so a config push never mixes values
+SensorData readSensors(const RuntimeConfig& cfg) {
   SensorData data;
   
   //-------------------------------------------------------------------------
   // ZMPT101B (Voltage Sensor) Reading
   //-------------------------------------------------------------------------
-  long zmptSum = 0;
-  int zmptMax = 0, zmptMin = 4095;
+  WindowStats zmpt = {0, 4095, 0, 0, cfg.samples};
   
-  for(int i = 0; i < SAMPLES; i++) {
+  for(int i = 0; i < cfg.samples; i++) {
     int reading = analogRead(ZMPT101B_PIN);
-    zmptSum += reading;
+    zmpt.sum += reading;
     
     // Track min/max for AC signal detection
-    if(reading > zmptMax) zmptMax = reading;
-    if(reading < zmptMin) zmptMin = reading;
+    if(reading > zmpt.max) zmpt.max = reading;
+    if(reading < zmpt.min) zmpt.min = reading;
+    if(reading <= 0 || reading >= 4095) zmpt.clipped++;
     
     delay(1);
   }
   
-  data.zmptRaw = zmptSum / SAMPLES;
+  data.zmptRaw = zmpt.sum / cfg.samples;
+  zmptCalibrator.setThreshold(cfg.zmptThreshold);
+  data.zmptQuality = zmptCalibrator.update(zmpt);
   
   // Calculate RMS voltage (simplified)
-  int zmptPeakToPeak = zmptMax - zmptMin;
+  float zmptPeakToPeak = zmptCalibrator.peakToPeak(zmpt);
   float zmptVoltage = (zmptPeakToPeak / ADC_RESOLUTION) * ADC_REF_VOLTAGE;
-  data.voltage = zmptVoltage * VOLTAGE_CALIBRATION / 2.0; // Convert to RMS
+  data.voltage = zmptVoltage * cfg.voltageCalibration * zmptCalibrator.getGain() / 2.0; // Convert to RMS
   
-  // Check if sensor is active (has AC signal variation)
-  data.zmptActive = (zmptPeakToPeak > ZMPT_THRESHOLD);
+  // Check if sensor is active (has AC signal variation above noise floor)
+  data.zmptActive = zmptCalibrator.isActive(zmpt);
+  
+  // Pending reference-meter calibration (serial "CALV <volts>"), then store
+  if (data.zmptActive && zmptCalibrator.applyGainCalibration(data.voltage)) {
+    data.voltage = zmptVoltage * cfg.voltageCalibration * zmptCalibrator.getGain() / 2.0;
+  }
+  zmptCalibrator.persist();
   
   // Threshold check voltage
-  data.voltageOutOfRange = (data.voltage < VOLT_MIN || data.voltage > VOLT_MAX);
+  data.voltageOutOfRange = (data.voltage < cfg.voltMin || data.voltage > cfg.voltMax);
   
   //-------------------------------------------------------------------------
   // SCT013 (Current Sensor) Reading
   //-------------------------------------------------------------------------
-  long sctSum = 0;
-  int sctMax = 0, sctMin = 4095;
+  WindowStats sct = {0, 4095, 0, 0, cfg.samples};
   
-  for(int i = 0; i < SAMPLES; i++) {
+  for(int i = 0; i < cfg.samples; i++) {
     int reading = analogRead(SCT013_PIN);
-    sctSum += reading;
+    sct.sum += reading;
     
     // Track min/max for AC signal detection
-    if(reading > sctMax) sctMax = reading;
-    if(reading < sctMin) sctMin = reading;
+    if(reading > sct.max) sct.max = reading;
+    if(reading < sct.min) sct.min = reading;
+    if(reading <= 0 || reading >= 4095) sct.clipped++;
     
     delay(1);
   }
   
-  data.sctRaw = sctSum / SAMPLES;
+  data.sctRaw = sct.sum / cfg.samples;
+  sctCalibrator.setThreshold(cfg.sctThreshold);
+  data.sctQuality = sctCalibrator.update(sct);
   
   // Calculate RMS current (simplified)
-  int sctPeakToPeak = sctMax - sctMin;
+  float sctPeakToPeak = sctCalibrator.peakToPeak(sct);
   float sctVoltage = (sctPeakToPeak / ADC_RESOLUTION) * ADC_REF_VOLTAGE;
-  data.current = sctVoltage * CURRENT_CALIBRATION / 2.0; // Convert to RMS
+  data.current = sctVoltage * cfg.currentCalibration * sctCalibrator.getGain() / 2.0; // Convert to RMS
   
-  // Check if sensor is active (has AC signal variation)
-  data.sctActive = (sctPeakToPeak > SCT_THRESHOLD);
+  // Check if sensor is active (has AC signal variation above noise floor)
+  data.sctActive = sctCalibrator.isActive(sct);
+  
+  // Pending reference-meter calibration (serial "CALI <amps>"), then store
+  if (data.sctActive && sctCalibrator.applyGainCalibration(data.current)) {
+    data.current = sctVoltage * cfg.currentCalibration * sctCalibrator.getGain() / 2.0;
+  }
+  sctCalibrator.persist();
 
   // Threshold check current
-  data.currentOverlimit = (data.current > CURRENT_MAX);
+  data.currentOverlimit = (data.current > cfg.currentMax);
+  
+  // Anomaly detection, skipped while a channel reading is unusable
+  if ((data.zmptQuality.faults | data.sctQuality.faults) & FAULT_CRITICAL) {
+    data.anomaly = anomalyDetector.getReport();
+  } else {
+    data.anomaly = anomalyDetector.update(data.voltage, data.current, currentSlot(), millis());
+  }
   
   //-------------------------------------------------------------------------
   // ADD NEW SENSOR READINGS BELOW:
@@ -316,12 +375,12 @@ SensorData readSensors() {
 
   // Threshold checks for DHT only when valid
   if (!isnan(t)) {
-    data.tempOutOfRange = (t < TEMP_LOW || t > TEMP_HIGH);
+    data.tempOutOfRange = (t < cfg.tempLow || t > cfg.tempHigh);
   } else {
     data.tempOutOfRange = false;
   }
   if (!isnan(h)) {
-    data.humOutOfRange = (h < HUM_LOW || h > HUM_HIGH);
+    data.humOutOfRange = (h < cfg.humLow || h > cfg.humHigh);
   } else {
     data.humOutOfRange = false;
   }
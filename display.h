@@ -34,6 +34,28 @@ public:
     // No need to display JSON in serial
   }
   
+  // Serial commands: "CALV <volts>" calibrates ZMPT101B gain against a
+  // reference meter reading taken at the same time
+  static void pollCommands() {
+    if (!DEBUG_ENABLED || !Serial || !Serial.available()) return;
+    String line = Serial.readStringUntil('\n');
+    line.trim();
+    // Reference meter readings: "CALV <volts>" or "CALI <amps>"
+    ChannelCalibrator* target = nullptr;
+    if (line.startsWith("CALV ")) target = &zmptCalibrator;
+    if (line.startsWith("CALI ")) target = &sctCalibrator;
+    if (target) {
+      float reference = line.substring(5).toFloat();
+      if (reference > 0) {
+        target->requestGainCalibration(reference);
+        Serial.print(line.substring(0, 4));
+        Serial.println(F(" pending"));
+        return;
+      }
+    }
+    Serial.println(F("CMD ?"));
+  }
+
   static void printHTTP(int code) {
     if (DEBUG_ENABLED && Serial) {
       Serial.println(code == 200 ? "HTTP: OK" : "HTTP: ERR");
@@ -0,0 +1,194 @@
+//=============================================================================
+// ESP32 Energy Monitor - Runtime Configuration Store
+//=============================================================================
+
+#ifndef RUNTIME_CONFIG_H
+#define RUNTIME_CONFIG_H
+
+#include <atomic>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include "config.h"
+
+// Default for config.h files created before the runtime config store existed
+#ifndef CONFIG_NVS_NAMESPACE
+#define CONFIG_NVS_NAMESPACE "cfg"
+#endif
+
+//=============================================================================
+// CONFIG SNAPSHOT - bump CONFIG_SCHEMA_VERSION when this layout changes
+//=============================================================================
+
+#define CONFIG_SCHEMA_VERSION 1
+
+struct RuntimeConfig {
+  uint16_t schema;            // CONFIG_SCHEMA_VERSION
+  uint16_t samples;           // SAMPLES
+  uint32_t revision;          // server-assigned, 0 = compiled defaults
+  uint32_t sendInterval;      // SEND_INTERVAL (ms)
+  uint32_t displayUpdate;     // DISPLAY_UPDATE (ms)
+  uint16_t zmptThreshold;     // ZMPT_THRESHOLD (ADC counts)
+  uint16_t sctThreshold;      // SCT_THRESHOLD (ADC counts)
+  uint8_t humLow;             // HUM_LOW (%)
+  uint8_t humHigh;            // HUM_HIGH (%)
+  float voltMin;              // VOLT_MIN
+  float voltMax;              // VOLT_MAX
+  float currentMax;           // CURRENT_MAX
+  float tempLow;              // TEMP_LOW
+  float tempHigh;             // TEMP_HIGH
+  float voltageCalibration;   // VOLTAGE_CALIBRATION
+  float currentCalibration;   // CURRENT_CALIBRATION
+};
+
+inline RuntimeConfig defaultConfig() {
+  RuntimeConfig cfg;
+  cfg.schema = CONFIG_SCHEMA_VERSION;
+  cfg.samples = SAMPLES;
+  cfg.revision = 0;
+  cfg.sendInterval = SEND_INTERVAL;
+  cfg.displayUpdate = DISPLAY_UPDATE;
+  cfg.zmptThreshold = ZMPT_THRESHOLD;
+  cfg.sctThreshold = SCT_THRESHOLD;
+  cfg.humLow = HUM_LOW;
+  cfg.humHigh = HUM_HIGH;
+  cfg.voltMin = VOLT_MIN;
+  cfg.voltMax = VOLT_MAX;
+  cfg.currentMax = CURRENT_MAX;
+  cfg.tempLow = TEMP_LOW;
+  cfg.tempHigh = TEMP_HIGH;
+  cfg.voltageCalibration = VOLTAGE_CALIBRATION;
+  cfg.currentCalibration = CURRENT_CALIBRATION;
+  return cfg;
+}
+
+// Reject values that would stall tasks or make readings meaningless
+inline bool isValidConfig(const RuntimeConfig& cfg) {
+  return cfg.schema == CONFIG_SCHEMA_VERSION &&
+         cfg.samples >= 10 && cfg.samples <= 1000 &&
+         cfg.sendInterval >= 1000 && cfg.sendInterval <= 3600000 &&
+         cfg.displayUpdate >= 100 && cfg.displayUpdate <= 60000 &&
+         cfg.zmptThreshold >= 1 && cfg.zmptThreshold < 4096 &&
+         cfg.sctThreshold >= 1 && cfg.sctThreshold < 4096 &&
+         cfg.humLow < cfg.humHigh && cfg.humHigh <= 100 &&
+         cfg.voltMin < cfg.voltMax && cfg.currentMax > 0 &&
+         cfg.tempLow < cfg.tempHigh &&
+         cfg.voltageCalibration > 0 && cfg.currentCalibration > 0;
+}
+
+//=============================================================================
+// CONFIG STORE
+//=============================================================================
+// Single writer (network task), many readers. Readers never block: they copy
+// the snapshot and retry if a publish happened meanwhile (seqlock), so every
+// reading cycle sees one complete config, never a mix of old and new values.
+
+class ConfigStore {
+private:
+  RuntimeConfig current;
+  std::atomic<uint32_t> sequence;   // odd while a publish is in progress
+
+  // Missing key keeps the current value; a key with the wrong type or out of
+  // the field's range fails the whole update
+  template <typename T>
+  static bool readField(JsonObjectConst remote, const char* key, T& field) {
+    JsonVariantConst value = remote[key];
+    if (value.isNull()) return true;
+    if (!value.is<T>()) return false;
+    field = value.as<T>();
+    return true;
+  }
+
+  void publish(const RuntimeConfig& next) {
+    sequence.fetch_add(1, std::memory_order_acq_rel);
+    std::atomic_thread_fence(std::memory_order_release);
+    current = next;
+    std::atomic_thread_fence(std::memory_order_release);
+    sequence.fetch_add(1, std::memory_order_release);
+  }
+
+  void save(const RuntimeConfig& cfg) {
+    Preferences prefs;
+    if (!prefs.begin(CONFIG_NVS_NAMESPACE, false)) return;
+    prefs.putBytes("cfg", &cfg, sizeof(cfg));
+    prefs.end();
+  }
+
+public:
+  ConfigStore() : current(defaultConfig()), sequence(0) {}
+
+  // Load the stored config from NVS (call once from setup, before tasks)
+  void begin() {
+    Preferences prefs;
+    if (!prefs.begin(CONFIG_NVS_NAMESPACE, true)) return;
+    RuntimeConfig stored;
+    bool found = prefs.getBytesLength("cfg") == sizeof(stored) &&
+                 prefs.getBytes("cfg", &stored, sizeof(stored)) == sizeof(stored);
+    prefs.end();
+
+    // Older schema or corrupt blob: keep compiled defaults
+    if (found && isValidConfig(stored)) {
+      publish(stored);
+    }
+  }
+
+  // Consistent copy of the active config, lock-free
+  RuntimeConfig snapshot() const {
+    RuntimeConfig copy;
+    uint32_t before, after;
+    do {
+      before = sequence.load(std::memory_order_acquire);
+      copy = current;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return copy;
+  }
+
+  uint32_t revision() const {
+    return snapshot().revision;
+  }
+
+  // Apply a "config" object from the server. Missing keys keep their value;
+  // the update is all-or-nothing and only accepted for a newer revision.
+  bool apply(JsonObjectConst remote) {
+    uint32_t rev = remote["rev"] | 0u;
+    RuntimeConfig next = snapshot();
+    if (rev <= next.revision) return false;
+
+    next.revision = rev;
+    bool ok = readField(remote, "samples", next.samples) &&
+              readField(remote, "send_interval_ms", next.sendInterval) &&
+              readField(remote, "display_update_ms", next.displayUpdate) &&
+              readField(remote, "zmpt_threshold", next.zmptThreshold) &&
+              readField(remote, "sct_threshold", next.sctThreshold) &&
+              readField(remote, "hum_low", next.humLow) &&
+              readField(remote, "hum_high", next.humHigh) &&
+              readField(remote, "volt_min", next.voltMin) &&
+              readField(remote, "volt_max", next.voltMax) &&
+              readField(remote, "current_max", next.currentMax) &&
+              readField(remote, "temp_low", next.tempLow) &&
+              readField(remote, "temp_high", next.tempHigh) &&
+              readField(remote, "voltage_cal", next.voltageCalibration) &&
+              readField(remote, "current_cal", next.currentCalibration);
+
+    if (!ok || !isValidConfig(next)) return false;
+
+    publish(next);
+    save(next);
+    return true;
+  }
+
+  // Look for a piggybacked "config" object in an upload response body
+  bool applyResponse(const String& body) {
+    if (body.length() == 0) return false;
+    JsonDocument response;
+    if (deserializeJson(response, body)) return false;
+    JsonObjectConst remote = response["config"].as<JsonObjectConst>();
+    if (remote.isNull()) return false;
+    return apply(remote);
+  }
+};
+
+static ConfigStore configStore;
+
+#endif
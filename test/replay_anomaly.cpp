@@ -0,0 +1,214 @@
+//=============================================================================
+// Host replay harness - AnomalyDetector latency and cost per sample
+//=============================================================================
+// Replays synthetic household data (250 ms per sample, the default `samples`
+// setting, or 2 s at samples=1000): daily load cycle,
+// extra daytime load on weekends, day-to-day variation, a cycling fridge and
+// kettle runs at random times, with one injected fault per scenario. Reports detection latency per
+// anomaly type, false firings before the fault and cycles per sample.
+// Uploads are simulated every UPLOAD_MS and acknowledged ACK_MS later; every
+// firing must reach an upload.
+
+#include <random>
+#include "test.h"
+#include "anomaly.h"
+
+static const unsigned long HOUR_MS = 3600000UL;
+static const unsigned long DAY_MS = 24 * HOUR_MS;
+static const unsigned long UPLOAD_MS = 60000;     // send_interval_ms
+static const unsigned long ACK_MS = 2000;         // POST round trip
+
+#if defined(__x86_64__) || defined(__i386__)
+static uint32_t hostCycles() { return (uint32_t)__builtin_ia32_rdtsc(); }
+#else
+static uint32_t hostCycles() { return cpuCycles(); }
+#endif
+
+struct Sample {
+  float voltage;
+  float current;
+};
+
+static bool isWeekend(unsigned long t) { return (t / DAY_MS) % 7 >= 5; }   // day 0 is a Monday
+
+// Normal household load in amps
+class Household {
+private:
+  std::mt19937 rng;
+  unsigned long day;
+  float scale;                        // day-to-day variation
+  unsigned long kettle[3];            // start times, 0 = not used that day
+
+  void newDay(unsigned long d) {
+    std::normal_distribution<float> dayScale(1, 0.04f);
+    std::uniform_real_distribution<float> uniform(0, 1);
+    const float usual[3] = {7, 12.5f, 19};
+    day = d;
+    scale = dayScale(rng);
+    for (int k = 0; k < 3; k++) {
+      float hour = usual[k] + (uniform(rng) - 0.5f) * 1.5f;
+      kettle[k] = uniform(rng) < 0.7f ? d * DAY_MS + (unsigned long)(hour * HOUR_MS) : 0;
+    }
+  }
+
+public:
+  Household() : rng(7), day(~0UL), scale(1), kettle{} {}
+
+  float current(unsigned long t) {
+    if (t / DAY_MS != day) newDay(t / DAY_MS);
+    float hourOfDay = (float)(t % DAY_MS) / HOUR_MS;
+    float amps = 2.0f + 1.0f * sinf((hourOfDay - 6) * 2 * (float)M_PI / 24);
+    if (isWeekend(t)) amps += 0.8f * expf(-powf((hourOfDay - 13) / 3, 2));
+    amps *= scale;
+    if ((t / 60000) % 47 < 15) amps += 0.6f;                          // fridge, 15 of 47 min
+    for (unsigned long start : kettle) {
+      if (start && t >= start && t < start + 180000) amps += 8;       // kettle, 3 min
+    }
+    return amps;
+  }
+};
+
+// Fault injected on top of the normal profile, t in ms since boot
+typedef void (*Fault)(unsigned long t, unsigned long onset, Sample& s);
+
+static void noFault(unsigned long, unsigned long, Sample&) {}
+
+static void creep(unsigned long t, unsigned long onset, Sample& s) {
+  if (t >= onset) s.current *= 1.0f + 0.10f * (t - onset) / DAY_MS;   // +10% per day
+}
+
+static void sag(unsigned long t, unsigned long onset, Sample& s) {
+  if (t >= onset && t < onset + 30000) s.voltage -= 10;              // 30 s, -10 V
+}
+
+static void step(unsigned long t, unsigned long onset, Sample& s) {
+  if (t >= onset) s.current += 3;                                    // new 3 A appliance
+}
+
+static void nightLoad(unsigned long t, unsigned long onset, Sample& s) {
+  if (t >= onset && t < onset + HOUR_MS) s.current *= 2.0f;          // one hour at twice the load
+}
+
+struct Scenario {
+  const char* name;
+  Fault fault;
+  unsigned long onset;
+  int8_t expect;                      // AnomalyType or -1
+  unsigned long maxLatency;
+  unsigned long sampleMs;             // time between readSensors() calls
+};
+
+struct Result {
+  unsigned long latency[ANOMALY_TYPE_COUNT];
+  bool detected[ANOMALY_TYPE_COUNT];
+  int falseFirings[ANOMALY_TYPE_COUNT];
+  int lost;                           // firings missing from the next upload
+  double avgCycles;
+  uint32_t maxCycles;
+  uint32_t overruns;
+};
+
+static Result replay(const Scenario& sc, unsigned long duration) {
+  AnomalyDetector detector(hostCycles);
+  Household household;
+  std::mt19937 rng(42);
+  std::normal_distribution<float> noise(0, 1);
+  Result r = {};
+  uint8_t lastActive = 0;
+  uint8_t risen = 0;                  // types that fired since the last upload
+  AnomalyReport sent = {};
+  bool ackPending = false;
+  double cycleSum = 0;
+  unsigned long samples = 0;
+
+  for (unsigned long t = 0; t < duration; t += sc.sampleMs) {
+    Sample s;
+    s.voltage = 220 + noise(rng);
+    s.current = household.current(t) + 0.05f * noise(rng);
+    sc.fault(t, sc.onset, s);
+
+    int slot = (int)((t % DAY_MS) / HOUR_MS) + (isWeekend(t) ? 24 : 0);
+    const AnomalyReport& report = detector.update(s.voltage, s.current, slot, t);
+    cycleSum += report.cycles;
+    samples++;
+
+    // Count rising edges only, ignore the first day (warm-up)
+    uint8_t rising = report.active & ~lastActive;
+    lastActive = report.active;
+    risen |= rising;
+
+    // Network task: the payload carries the report as it is now
+    if (t % UPLOAD_MS == 0) {
+      if (risen & ~report.active) r.lost++;
+      risen = 0;
+      sent = report;
+      ackPending = true;
+    }
+    // HTTP 200 arrives a little later, the detector kept running meanwhile
+    if (ackPending && t % UPLOAD_MS == ACK_MS) {
+      lastActive = detector.acknowledge(sent).active;
+      ackPending = false;
+    }
+    for (uint8_t type = 0; type < ANOMALY_TYPE_COUNT; type++) {
+      if (!(rising & (1 << type))) continue;
+      if (t >= sc.onset) {
+        if (!r.detected[type]) {
+          r.detected[type] = true;
+          r.latency[type] = t - sc.onset;
+        }
+      } else if (t >= DAY_MS) {
+        r.falseFirings[type]++;
+      }
+    }
+  }
+
+  r.avgCycles = cycleSum / samples;
+  r.maxCycles = detector.getReport().maxCycles;
+  r.overruns = detector.getReport().overruns;
+  return r;
+}
+
+int main() {
+  // Weekend hours need two weekends of history before they are scored
+  const unsigned long start = 15 * DAY_MS;
+  const Scenario scenarios[] = {
+    {"steady",     noFault,   29 * DAY_MS,             -1,                  0,                             250},
+    {"creep",      creep,     start,                   ANOMALY_LOAD_CREEP,  5 * DAY_MS,                    250},
+    {"sag",        sag,       start + 12 * HOUR_MS,    ANOMALY_VOLTAGE_SAG, 2 * ANOMALY_STEP_MS,           250},
+    {"step",       step,      start + 12 * HOUR_MS,    ANOMALY_SIGNATURE,   ANOMALY_SIGNATURE_MS + 60000,  250},
+    {"night_load", nightLoad, start + 3 * HOUR_MS,     ANOMALY_SEASONAL,    HOUR_MS + 60000,               250},
+    {"steady_2s",  noFault,   29 * DAY_MS,             -1,                  0,                             2000},
+    {"step_2s",    step,      start + 12 * HOUR_MS,    ANOMALY_SIGNATURE,   ANOMALY_SIGNATURE_MS + 60000,  2000},
+  };
+
+
+  printf("%-11s %-19s %12s %18s %5s %10s %10s %8s\n",
+         "scenario", "anomaly", "latency_s", "false(c/s/g/h)", "lost", "cyc/sample", "max_cyc", "overrun");
+  for (const Scenario& sc : scenarios) {
+    unsigned long duration = sc.expect < 0 ? sc.onset : sc.onset + sc.maxLatency + DAY_MS;
+    Result r = replay(sc, duration);
+
+    char latency[16] = "-";
+    if (sc.expect >= 0 && r.detected[sc.expect]) {
+      snprintf(latency, sizeof(latency), "%.1f", r.latency[sc.expect] / 1000.0);
+    }
+    char falses[32];
+    snprintf(falses, sizeof(falses), "%d/%d/%d/%d", r.falseFirings[0], r.falseFirings[1],
+             r.falseFirings[2], r.falseFirings[3]);
+    printf("%-11s %-19s %12s %18s %5d %10.0f %10u %8u\n", sc.name,
+           sc.expect >= 0 ? anomalyName(sc.expect) : "-", latency, falses, r.lost,
+           r.avgCycles, r.maxCycles, r.overruns);
+
+    if (sc.expect >= 0) {
+      CHECK(r.detected[sc.expect]);
+      CHECK(r.latency[sc.expect] <= sc.maxLatency);
+    }
+    CHECK(r.lost == 0);
+    // No detector may fire on normal household data
+    CHECK(r.falseFirings[ANOMALY_LOAD_CREEP] == 0);
+    CHECK(r.falseFirings[ANOMALY_SIGNATURE] == 0);
+    CHECK(r.falseFirings[ANOMALY_VOLTAGE_SAG] == 0);
+    CHECK(r.falseFirings[ANOMALY_SEASONAL] == 0);
+  }
+  return testResult();
+}
@@ -0,0 +1,38 @@
+//=============================================================================
+// Host test stub - minimal Arduino core
+//=============================================================================
+
+#ifndef ARDUINO_STUB_H
+#define ARDUINO_STUB_H
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+using std::fabs;
+using std::isnan;
+
+typedef std::string String;
+
+#define HIGH 1
+#define LOW 0
+
+// Test-controlled clock
+inline unsigned long& fakeMillis() {
+  static unsigned long now = 0;
+  return now;
+}
+inline unsigned long millis() { return fakeMillis(); }
+
+// Host stand-in for the Xtensa cycle counter (nanoseconds)
+struct EspStub {
+  uint32_t getCycleCount() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+  }
+};
+[[maybe_unused]] static EspStub ESP;
+
+#endif
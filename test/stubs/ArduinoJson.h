@@ -0,0 +1,225 @@
+//=============================================================================
+// Host test stub - the small ArduinoJson 7 surface used by runtime_config.h
+//=============================================================================
+// Tests build JsonObjectConst values directly or parse a response body with
+// deserializeJson (objects, numbers, strings, booleans, null; arrays are
+// parsed but their contents are dropped).
+
+#ifndef ARDUINOJSON_STUB_H
+#define ARDUINOJSON_STUB_H
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+class JsonVariantConst;
+class JsonObjectConst;
+typedef std::map<std::string, JsonVariantConst> JsonFields;
+
+class JsonVariantConst {
+private:
+  enum Kind { NUL, INTEGER, REAL, TEXT, BOOLEAN, ARRAY, OBJECT } kind;
+  long long integer;
+  double real;
+  std::shared_ptr<JsonFields> object;
+
+public:
+  JsonVariantConst() : kind(NUL), integer(0), real(0) {}
+  static JsonVariantConst of(long long v) { JsonVariantConst j; j.kind = INTEGER; j.integer = v; return j; }
+  static JsonVariantConst of(int v) { return of((long long)v); }
+  static JsonVariantConst of(double v) { JsonVariantConst j; j.kind = REAL; j.real = v; return j; }
+  static JsonVariantConst of(bool v) { JsonVariantConst j; j.kind = BOOLEAN; j.integer = v; return j; }
+  static JsonVariantConst text() { JsonVariantConst j; j.kind = TEXT; return j; }
+  static JsonVariantConst array() { JsonVariantConst j; j.kind = ARRAY; return j; }
+  static JsonVariantConst of(const std::shared_ptr<JsonFields>& fields) {
+    JsonVariantConst j;
+    j.kind = OBJECT;
+    j.object = fields;
+    return j;
+  }
+
+  bool isNull() const { return kind == NUL; }
+
+  // Same rules as ArduinoJson 7: integers must fit T, floats never match integers
+  template <typename T>
+  bool is() const {
+    if (std::is_floating_point<T>::value) return kind == INTEGER || kind == REAL;
+    if (kind != INTEGER) return false;
+    return integer >= (long long)std::numeric_limits<T>::min() &&
+           integer <= (long long)std::numeric_limits<T>::max();
+  }
+
+  template <typename T>
+  T as() const {
+    return kind == REAL ? (T)real : (T)integer;
+  }
+
+  template <typename T>
+  T operator|(T defaultValue) const {
+    return is<T>() ? as<T>() : defaultValue;
+  }
+
+  JsonVariantConst operator[](const char* key) const;
+};
+
+class JsonObjectConst {
+private:
+  const JsonFields* fields;
+
+public:
+  JsonObjectConst(const JsonFields* fields = nullptr) : fields(fields) {}
+  bool isNull() const { return fields == nullptr; }
+  JsonVariantConst operator[](const char* key) const {
+    if (!fields) return JsonVariantConst();
+    auto it = fields->find(key);
+    return it == fields->end() ? JsonVariantConst() : it->second;
+  }
+};
+
+template <>
+inline JsonObjectConst JsonVariantConst::as<JsonObjectConst>() const {
+  return kind == OBJECT ? JsonObjectConst(object.get()) : JsonObjectConst();
+}
+
+inline JsonVariantConst JsonVariantConst::operator[](const char* key) const {
+  return as<JsonObjectConst>()[key];
+}
+
+class JsonDocument {
+public:
+  JsonVariantConst root;
+  JsonVariantConst operator[](const char* key) const { return root[key]; }
+};
+
+struct DeserializationError {
+  bool failed;
+  explicit operator bool() const { return failed; }
+};
+
+// Recursive descent over the subset of JSON the tests send
+class JsonParser {
+private:
+  const char* p;
+
+  void skipSpace() {
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+  }
+
+  bool literal(const char* word) {
+    size_t n = strlen(word);
+    if (strncmp(p, word, n) != 0) return false;
+    p += n;
+    return true;
+  }
+
+  bool parseString(std::string& out) {
+    if (*p != '"') return false;
+    p++;
+    out.clear();
+    while (*p && *p != '"') {
+      if (*p == '\\') {
+        p++;
+        if (!*p) return false;
+      }
+      out += *p++;
+    }
+    if (*p != '"') return false;
+    p++;
+    return true;
+  }
+
+  bool parseNumber(JsonVariantConst& out) {
+    const char* start = p;
+    if (*p == '-') p++;
+    if (*p < '0' || *p > '9') return false;
+    bool isReal = false;
+    while ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' || *p == '+' || *p == '-') {
+      if (*p == '.' || *p == 'e' || *p == 'E') isReal = true;
+      p++;
+    }
+    std::string number(start, p);
+    out = isReal ? JsonVariantConst::of(strtod(number.c_str(), nullptr))
+                 : JsonVariantConst::of(strtoll(number.c_str(), nullptr, 10));
+    return true;
+  }
+
+public:
+  explicit JsonParser(const char* text) : p(text) {}
+
+  bool parseValue(JsonVariantConst& out, int depth = 0) {
+    if (depth > 10) return false;
+    skipSpace();
+    if (*p == '{') {
+      p++;
+      auto fields = std::make_shared<JsonFields>();
+      skipSpace();
+      if (*p == '}') {
+        p++;
+      } else {
+        for (;;) {
+          std::string key;
+          JsonVariantConst value;
+          skipSpace();
+          if (!parseString(key)) return false;
+          skipSpace();
+          if (*p++ != ':') return false;
+          if (!parseValue(value, depth + 1)) return false;
+          (*fields)[key] = value;
+          skipSpace();
+          if (*p == ',') { p++; continue; }
+          if (*p++ != '}') return false;
+          break;
+        }
+      }
+      out = JsonVariantConst::of(fields);
+      return true;
+    }
+    if (*p == '[') {
+      p++;
+      skipSpace();
+      if (*p == ']') {
+        p++;
+      } else {
+        for (;;) {
+          JsonVariantConst item;
+          if (!parseValue(item, depth + 1)) return false;
+          skipSpace();
+          if (*p == ',') { p++; continue; }
+          if (*p++ != ']') return false;
+          break;
+        }
+      }
+      out = JsonVariantConst::array();
+      return true;
+    }
+    if (*p == '"') {
+      std::string text;
+      if (!parseString(text)) return false;
+      out = JsonVariantConst::text();
+      return true;
+    }
+    if (literal("true")) { out = JsonVariantConst::of(true); return true; }
+    if (literal("false")) { out = JsonVariantConst::of(false); return true; }
+    if (literal("null")) { out = JsonVariantConst(); return true; }
+    return parseNumber(out);
+  }
+
+  bool atEnd() {
+    skipSpace();
+    return *p == '\0';
+  }
+};
+
+inline DeserializationError deserializeJson(JsonDocument& doc, const String& input) {
+  JsonParser parser(input.c_str());
+  JsonVariantConst root;
+  bool ok = parser.parseValue(root) && parser.atEnd();
+  doc.root = ok ? root : JsonVariantConst();
+  return DeserializationError{!ok};
+}
+
+#endif
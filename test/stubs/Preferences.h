@@ -0,0 +1,64 @@
+//=============================================================================
+// Host test stub - in-memory NVS
+//=============================================================================
+
+#ifndef PREFERENCES_STUB_H
+#define PREFERENCES_STUB_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences {
+private:
+  std::string ns;
+
+  std::vector<uint8_t>* find(const char* key) {
+    auto it = storage().find(ns + "/" + key);
+    return it == storage().end() ? nullptr : &it->second;
+  }
+
+public:
+  static std::map<std::string, std::vector<uint8_t>>& storage() {
+    static std::map<std::string, std::vector<uint8_t>> values;
+    return values;
+  }
+  static int& writes() {
+    static int count = 0;
+    return count;
+  }
+
+  bool begin(const char* name, bool readOnly) {
+    (void) readOnly;
+    ns = name;
+    return true;
+  }
+  void end() {}
+
+  size_t putBytes(const char* key, const void* value, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)value;
+    storage()[ns + "/" + key].assign(bytes, bytes + len);
+    writes()++;
+    return len;
+  }
+  size_t getBytesLength(const char* key) {
+    std::vector<uint8_t>* value = find(key);
+    return value ? value->size() : 0;
+  }
+  size_t getBytes(const char* key, void* buf, size_t maxLen) {
+    std::vector<uint8_t>* value = find(key);
+    if (!value || value->size() > maxLen) return 0;
+    memcpy(buf, value->data(), value->size());
+    return value->size();
+  }
+
+  size_t putFloat(const char* key, float value) {
+    return putBytes(key, &value, sizeof(value));
+  }
+  float getFloat(const char* key, float defaultValue) {
+    float value;
+    return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+  }
+};
+
+#endif
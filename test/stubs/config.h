@@ -0,0 +1,2 @@
+// Host tests build against the shipped template
+#include "../../config_example.h"
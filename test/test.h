@@ -0,0 +1,26 @@
+//=============================================================================
+// Host test helpers
+//=============================================================================
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <cstdio>
+
+static int testFailures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+      testFailures++; \
+    } \
+  } while (0)
+
+#define RUN(test) do { printf("%s\n", #test); test(); } while (0)
+
+inline int testResult() {
+  printf(testFailures ? "%d FAILED\n" : "OK\n", testFailures);
+  return testFailures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,212 @@
+//=============================================================================
+// Host tests - ChannelCalibrator fault detection
+//=============================================================================
+
+#include "test.h"
+#include "calibration.h"
+
+static const int MID = 2047;
+
+// One window of a sine around `center`, optionally clamped to the ADC range
+static WindowStats sineWindow(float center, float amplitude, int samples = 100) {
+  WindowStats w = {0, 4095, 0, 0, samples};
+  for (int i = 0; i < samples; i++) {
+    int reading = (int)(center + amplitude * sinf(i * 0.314f));
+    if (reading < 0) reading = 0;
+    if (reading > 4095) reading = 4095;
+    w.sum += reading;
+    if (reading > w.max) w.max = reading;
+    if (reading < w.min) w.min = reading;
+    if (reading <= 0 || reading >= 4095) w.clipped++;
+  }
+  return w;
+}
+
+static WindowStats flatWindow(int value, int samples = 100) {
+  WindowStats w = {(long)value * samples, value, value, 0, samples};
+  if (value <= 0 || value >= 4095) w.clipped = samples;
+  return w;
+}
+
+static void warmUp(ChannelCalibrator& cal, float center = MID) {
+  for (int i = 0; i < CALIB_WARMUP_WINDOWS; i++) cal.update(sineWindow(center, 1000));
+}
+
+static void testHealthySignal() {
+  ChannelCalibrator cal("t_off", "t_gain", ZMPT_THRESHOLD);
+  warmUp(cal);
+  WindowStats w = sineWindow(MID, 1000);
+  const ChannelQuality& q = cal.update(w);
+  CHECK(q.faults == FAULT_NONE);
+  CHECK(q.calibrated);
+  CHECK(fabs(q.offset - MID) < 5);
+  CHECK(cal.isActive(w));
+  CHECK(fabs(cal.peakToPeak(w) - (w.max - w.min)) < 1);
+}
+
+static void testNotCalibratedBeforeWarmup() {
+  ChannelCalibrator cal("t_off", "t_gain", ZMPT_THRESHOLD);
+  const ChannelQuality& q = cal.update(sineWindow(MID, 1000));
+  CHECK(q.faults == FAULT_NONE);
+  CHECK(!q.calibrated);
+}
+
+static void testClippingRebuildsPeakToPeak() {
+  ChannelCalibrator cal("t_off", "t_gain", ZMPT_THRESHOLD);
+  warmUp(cal);
+  float learned = cal.update(sineWindow(MID, 1000)).offset;
+
+  // Overdriven signal shifted upward: top clips at 4095
+  WindowStats w = sineWindow(MID + 300, 2200);
+  const ChannelQuality& q = cal.update(w);
+  CHECK(q.faults & FAULT_CLIPPING);
+  CHECK(!(q.faults & FAULT_CRITICAL));
+  CHECK(q.offset == learned);                      // clipped windows do not teach the offset
+  // Rebuilt as twice the larger half-swing around the learned offset
+  float half = fmaxf(w.max - learned, learned - w.min);
+  CHECK(cal.peakToPeak(w) > w.max - w.min);
+  CHECK(fabs(cal.peakToPeak(w) - 2 * half) < 1);
+}
+
+static void testOffsetDrift() {
+  ChannelCalibrator cal("t_off", "t_gain", ZMPT_THRESHOLD);
+  warmUp(cal);
+  CHECK(!(cal.update(sineWindow(MID, 500)).faults & FAULT_OFFSET_DRIFT));
+
+  // Bias walks up by 600 counts; the slow EWMA follows and crosses the limit
+  bool flagged = false;
+  for (int i = 0; i < 2000 && !flagged; i++) {
+    flagged = cal.update(sineWindow(MID + 600, 500)).faults & FAULT_OFFSET_DRIFT;
+  }
+  CHECK(flagged);
+  const ChannelQuality& q = cal.update(sineWindow(MID + 600, 500));
+  CHECK(q.faults & FAULT_OFFSET_DRIFT);
+  CHECK(!q.calibrated);
+}
+
+static void testRailParkedInputIsDisconnected() {
+  ChannelCalibrator cal("t_off", "t_gain", SCT_THRESHOLD);
+  warmUp(cal);
+  float learned = cal.update(sineWindow(MID, 1000)).offset;
+
+  WindowStats low = flatWindow(0);
+  const ChannelQuality& q = cal.update(low);
+  CHECK(q.faults & FAULT_DISCONNECTED);
+  CHECK(!(q.faults & FAULT_CLIPPING));
+  CHECK(!q.calibrated);
+  CHECK(!cal.isActive(low));
+  CHECK(q.offset == learned);
+
+  CHECK(cal.update(flatWindow(4095)).faults & FAULT_DISCONNECTED);
+
+  // Reconnect clears the fault
+  CHECK(!(cal.update(sineWindow(MID, 1000)).faults & FAULT_DISCONNECTED));
+}
+
+static void testStuckValue() {
+  ChannelCalibrator cal("t_off", "t_gain", ZMPT_THRESHOLD);
+  warmUp(cal);
+  uint8_t faults = 0;
+  for (int i = 0; i < CALIB_STUCK_WINDOWS - 1; i++) faults = cal.update(flatWindow(MID)).faults;
+  CHECK(!(faults & FAULT_STUCK));
+
+  WindowStats w = flatWindow(MID);
+  const ChannelQuality& q = cal.update(w);
+  CHECK(q.faults & FAULT_STUCK);
+  CHECK(!(q.faults & FAULT_DISCONNECTED));
+  CHECK(!q.calibrated);
+  CHECK(!cal.isActive(w));
+
+  CHECK(!(cal.update(sineWindow(MID, 1000)).faults & FAULT_STUCK));
+}
+
+// Steady window with a fixed peak-to-peak around mid-scale
+static WindowStats rippleWindow(int peakToPeak, int samples = 100) {
+  WindowStats w = {(long)MID * samples, MID - peakToPeak / 2, MID - peakToPeak / 2 + peakToPeak, 0, samples};
+  return w;
+}
+
+static void testNoiseFloor() {
+  ChannelCalibrator cal("t_off", "t_gain", SCT_THRESHOLD);
+  warmUp(cal);
+  // Idle channel with noise right at the threshold
+  WindowStats idle = rippleWindow(SCT_THRESHOLD);
+  uint8_t faults = 0;
+  for (int i = 0; i < 200; i++) faults = cal.update(idle).faults;
+  CHECK(faults & FAULT_NOISY);
+  // A window just above the threshold is still within the noise margin
+  WindowStats w = rippleWindow(SCT_THRESHOLD + 2);
+  cal.update(w);
+  CHECK(!cal.isActive(w));
+  CHECK(cal.isActive(sineWindow(MID, 100)));
+}
+
+static void testSteadySmallLoadStaysActive() {
+  ChannelCalibrator cal("t_off", "t_gain", SCT_THRESHOLD);
+  warmUp(cal);
+  // Router/fridge standby: ~0.15 A, always on, a little above the threshold
+  WindowStats w = rippleWindow(12);
+  for (int i = 0; i < 1000; i++) {
+    const ChannelQuality& q = cal.update(w);
+    CHECK(!(q.faults & FAULT_NOISY));
+    CHECK(cal.isActive(w));
+    if (testFailures) break;
+  }
+  CHECK(cal.update(w).noiseFloor <= SCT_THRESHOLD);
+}
+
+static void testGainOnlyOnRequest() {
+  ChannelCalibrator cal("t_off", "t_gain", ZMPT_THRESHOLD);
+  warmUp(cal);
+  cal.update(sineWindow(MID, 1000));
+  CHECK(!cal.applyGainCalibration(212.0));
+  CHECK(cal.getGain() == 1.0f);
+
+  cal.requestGainCalibration(220.0);
+  CHECK(cal.applyGainCalibration(212.0));
+  CHECK(fabs(cal.getGain() - 220.0 / 212.0) < 1e-4);
+  CHECK(!cal.applyGainCalibration(212.0));         // one shot
+
+  // Out of range requests are dropped
+  cal.requestGainCalibration(400.0);
+  float before = cal.getGain();
+  CHECK(!cal.applyGainCalibration(212.0));
+  CHECK(cal.getGain() == before);
+
+  // A request made while the channel is faulty waits for a healthy window
+  cal.requestGainCalibration(215.0);
+  cal.update(flatWindow(0));
+  CHECK(!cal.applyGainCalibration(212.0));
+  cal.update(sineWindow(MID, 1000));
+  CHECK(cal.applyGainCalibration(212.0));
+  CHECK(fabs(cal.getGain() - before * 215.0 / 212.0) < 1e-4);
+}
+
+static void testPersistAndRestore() {
+  Preferences::storage().clear();
+  fakeMillis() = 1;
+  {
+    ChannelCalibrator cal("p_off", "p_gain", ZMPT_THRESHOLD);
+    warmUp(cal, MID + 100);
+    cal.persist();
+  }
+  ChannelCalibrator restored("p_off", "p_gain", ZMPT_THRESHOLD);
+  restored.begin();
+  const ChannelQuality& q = restored.update(sineWindow(MID + 100, 1000));
+  CHECK(q.calibrated);                             // no new warm-up needed
+  CHECK(fabs(q.offset - (MID + 100)) < 5);
+}
+
+int main() {
+  RUN(testHealthySignal);
+  RUN(testNotCalibratedBeforeWarmup);
+  RUN(testClippingRebuildsPeakToPeak);
+  RUN(testOffsetDrift);
+  RUN(testRailParkedInputIsDisconnected);
+  RUN(testStuckValue);
+  RUN(testNoiseFloor);
+  RUN(testSteadySmallLoadStaysActive);
+  RUN(testGainOnlyOnRequest);
+  RUN(testPersistAndRestore);
+  return testResult();
+}
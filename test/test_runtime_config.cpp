@@ -0,0 +1,286 @@
+//=============================================================================
+// Host tests - ConfigStore validation, persistence and concurrent snapshots
+//=============================================================================
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "test.h"
+#include "runtime_config.h"
+
+static JsonVariantConst num(long long v) { return JsonVariantConst::of(v); }
+static JsonVariantConst real(double v) { return JsonVariantConst::of(v); }
+
+// Upload response with every field derived from the revision, so a torn
+// snapshot is detectable
+static String responseFor(uint32_t rev) {
+  char body[512];
+  snprintf(body, sizeof(body),
+           "{\"status\": \"ok\", \"ids\": [1, 2], \"config\": {\"rev\": %u, "
+           "\"samples\": %u, \"send_interval_ms\": %u, \"display_update_ms\": %u, "
+           "\"zmpt_threshold\": %u, \"sct_threshold\": %u, \"hum_low\": %u, \"hum_high\": %u, "
+           "\"volt_min\": %u, \"volt_max\": %u, \"current_max\": %u.0, \"temp_low\": %u, "
+           "\"temp_high\": %u.0, \"voltage_cal\": %u.0, \"current_cal\": %u}}",
+           rev, 10 + rev % 991, 1000 + rev, 100 + rev % 59901,
+           1 + rev % 4000, 1 + (rev * 7) % 4000, rev % 50, 50 + rev % 51,
+           100 + rev % 80, 200 + rev % 100, 1 + rev % 50, rev % 10,
+           20 + rev % 20, 100 + rev % 300, 1 + rev % 100);
+  return body;
+}
+
+static uint16_t samplesFor(uint32_t rev) {
+  return rev == 0 ? SAMPLES : 10 + rev % 991;
+}
+
+// Field by field: memcmp would also compare padding bytes
+static bool sameConfig(const RuntimeConfig& a, const RuntimeConfig& b) {
+  return a.schema == b.schema && a.samples == b.samples && a.revision == b.revision &&
+         a.sendInterval == b.sendInterval && a.displayUpdate == b.displayUpdate &&
+         a.zmptThreshold == b.zmptThreshold && a.sctThreshold == b.sctThreshold &&
+         a.humLow == b.humLow && a.humHigh == b.humHigh &&
+         a.voltMin == b.voltMin && a.voltMax == b.voltMax && a.currentMax == b.currentMax &&
+         a.tempLow == b.tempLow && a.tempHigh == b.tempHigh &&
+         a.voltageCalibration == b.voltageCalibration &&
+         a.currentCalibration == b.currentCalibration;
+}
+
+static bool matchesRevision(const RuntimeConfig& cfg) {
+  uint32_t rev = cfg.revision;
+  if (rev == 0) return sameConfig(cfg, defaultConfig());
+  return cfg.samples == 10 + rev % 991 &&
+         cfg.sendInterval == 1000 + rev &&
+         cfg.displayUpdate == 100 + rev % 59901 &&
+         cfg.zmptThreshold == 1 + rev % 4000 &&
+         cfg.sctThreshold == 1 + (rev * 7) % 4000 &&
+         cfg.humLow == rev % 50 &&
+         cfg.humHigh == 50 + rev % 51 &&
+         cfg.voltMin == 100 + rev % 80 &&
+         cfg.voltMax == 200 + rev % 100 &&
+         cfg.currentMax == 1 + rev % 50 &&
+         cfg.tempLow == rev % 10 &&
+         cfg.tempHigh == 20 + rev % 20 &&
+         cfg.voltageCalibration == 100 + rev % 300 &&
+         cfg.currentCalibration == 1 + rev % 100;
+}
+
+static void testDefaultsAreValid() {
+  CHECK(isValidConfig(defaultConfig()));
+  ConfigStore store;
+  CHECK(store.revision() == 0);
+}
+
+static void testPartialUpdate() {
+  Preferences::storage().clear();
+  ConfigStore store;
+  JsonFields remote = {{"rev", num(3)}, {"send_interval_ms", num(10000)}, {"volt_max", real(245.5)}};
+  CHECK(store.apply(JsonObjectConst(&remote)));
+
+  RuntimeConfig cfg = store.snapshot();
+  CHECK(cfg.revision == 3);
+  CHECK(cfg.sendInterval == 10000);
+  CHECK(cfg.voltMax == 245.5f);
+  CHECK(cfg.samples == SAMPLES);                   // untouched keys keep their value
+  CHECK(cfg.zmptThreshold == ZMPT_THRESHOLD);
+}
+
+static void testStaleRevisionRejected() {
+  ConfigStore store;
+  JsonFields first = {{"rev", num(5)}, {"samples", num(200)}};
+  JsonFields stale = {{"rev", num(5)}, {"samples", num(300)}};
+  JsonFields missing = {{"samples", num(300)}};
+  CHECK(store.apply(JsonObjectConst(&first)));
+  CHECK(!store.apply(JsonObjectConst(&stale)));
+  CHECK(!store.apply(JsonObjectConst(&missing)));
+  CHECK(store.snapshot().samples == 200);
+}
+
+static void testBadFieldRejectsWholeUpdate() {
+  const JsonFields bad[] = {
+    {{"rev", num(9)}, {"send_interval_ms", num(9000)}, {"samples", num(70000)}},      // overflows uint16
+    {{"rev", num(9)}, {"send_interval_ms", real(5000.0)}},                           // float for integer
+    {{"rev", num(9)}, {"send_interval_ms", num(9000)}, {"hum_low", num(-1)}},        // negative for uint8
+    {{"rev", num(9)}, {"send_interval_ms", num(9000)}, {"volt_max", JsonVariantConst::text()}},
+    {{"rev", num(9)}, {"zmpt_threshold", num(0)}},                                   // breaks the classifier
+    {{"rev", num(9)}, {"sct_threshold", num(0)}},
+    {{"rev", num(9)}, {"samples", num(5)}},                                          // below range
+    {{"rev", real(9.5)}, {"samples", num(200)}},
+  };
+  for (const JsonFields& remote : bad) {
+    ConfigStore store;
+    CHECK(!store.apply(JsonObjectConst(&remote)));
+    RuntimeConfig cfg = store.snapshot();
+    CHECK(cfg.revision == 0);                      // rev does not move forward
+    CHECK(matchesRevision(cfg));                   // nothing partially applied
+  }
+}
+
+static void testPersistAndRestore() {
+  Preferences::storage().clear();
+  {
+    ConfigStore store;
+    CHECK(store.applyResponse(responseFor(42)));
+  }
+  ConfigStore restored;
+  restored.begin();
+  RuntimeConfig cfg = restored.snapshot();
+  CHECK(cfg.revision == 42);
+  CHECK(matchesRevision(cfg));
+
+  // A blob from another schema version is ignored
+  RuntimeConfig old = cfg;
+  old.schema = CONFIG_SCHEMA_VERSION + 1;
+  Preferences prefs;
+  prefs.begin(CONFIG_NVS_NAMESPACE, false);
+  prefs.putBytes("cfg", &old, sizeof(old));
+  prefs.end();
+  ConfigStore fresh;
+  fresh.begin();
+  CHECK(fresh.revision() == 0);
+}
+
+static void testApplyResponse() {
+  Preferences::storage().clear();
+  ConfigStore store;
+  CHECK(store.applyResponse(
+      "{\"status\":\"ok\",\"config\":{\"rev\":7,\"send_interval_ms\":15000,\"volt_max\":245.5}}"));
+  RuntimeConfig cfg = store.snapshot();
+  CHECK(cfg.revision == 7);
+  CHECK(cfg.sendInterval == 15000);
+  CHECK(cfg.voltMax == 245.5f);
+  CHECK(cfg.samples == SAMPLES);
+
+  const char* ignored[] = {
+    "",                                                          // no body
+    "OK",                                                        // not JSON
+    "{\"config\":{\"rev\":8,\"samples\":200}",                     // truncated
+    "{\"status\":\"ok\"}",                                         // nothing piggybacked
+    "{\"config\":null}",
+    "{\"config\":{\"rev\":8,\"samples\":\"200\"}}",                  // wrong type
+    "{\"config\":{\"rev\":8,\"samples\":200.0}}",                   // float for integer
+    "{\"config\":{\"rev\":8,\"zmpt_threshold\":0}}",                // fails validation
+    "{\"config\":{\"rev\":7,\"samples\":200}}",                     // not newer
+  };
+  for (const char* body : ignored) {
+    CHECK(!store.applyResponse(body));
+  }
+  CHECK(store.revision() == 7);
+  CHECK(store.snapshot().samples == SAMPLES);
+
+  ConfigStore restored;
+  restored.begin();
+  CHECK(restored.revision() == 7);                 // applied response reached NVS
+}
+
+// Network task applies piggybacked updates while the sensor task keeps
+// reading and the network task keeps uploading. Every reading cycle must
+// produce exactly one complete record, delivered once, in order.
+struct Record {
+  uint32_t cycle;
+  uint32_t revision;
+  uint16_t taken;                     // samples read in this cycle
+};
+
+static void testUpdatesUnderLoad() {
+  Preferences::storage().clear();
+  ConfigStore store;
+  const uint32_t UPDATES = 20000;
+  std::atomic<bool> updating(true);
+  std::atomic<bool> sampling(true);
+  std::atomic<long> torn(0);
+  std::atomic<long> rejected(0);
+  std::mutex queueMutex;              // stands in for dataMutex
+  std::deque<Record> queue;
+  uint32_t produced = 0;
+
+  // taskSensor: one snapshot per readSensors() call, cfg.samples readings
+  std::thread sensor([&] {
+    while (sampling.load()) {
+      RuntimeConfig cfg = store.snapshot();
+      if (!matchesRevision(cfg)) torn++;
+      Record record = {produced, cfg.revision, 0};
+      for (int i = 0; i < cfg.samples; i++) record.taken++;
+      {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.push_back(record);
+      }
+      produced++;
+    }
+  });
+
+  // taskNetwork: upload what was read, piggybacked config in the response,
+  // wait cfg.sendInterval (scaled to microseconds) between uploads
+  std::vector<Record> delivered;
+  std::thread network([&] {
+    uint32_t rev = 1;
+    for (;;) {
+      bool more = rev <= UPDATES;
+      {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        delivered.insert(delivered.end(), queue.begin(), queue.end());
+        queue.clear();
+      }
+      if (!more && !sampling.load()) break;
+      if (more) {
+        if (!store.applyResponse(responseFor(rev))) rejected++;
+        rev++;
+      } else {
+        updating = false;
+        sampling = false;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(store.snapshot().sendInterval % 50));
+    }
+  });
+
+  // taskDisplay: snapshots only
+  std::thread display([&] {
+    while (updating.load()) {
+      if (!matchesRevision(store.snapshot())) torn++;
+    }
+  });
+
+  network.join();
+  sensor.join();
+  display.join();
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    delivered.insert(delivered.end(), queue.begin(), queue.end());
+  }
+
+  long lost = 0, incomplete = 0, backwards = 0;
+  uint32_t lastRev = 0;
+  for (uint32_t i = 0; i < delivered.size(); i++) {
+    const Record& record = delivered[i];
+    if (record.cycle != i) lost++;                 // gap, duplicate or reorder
+    if (record.taken != samplesFor(record.revision)) incomplete++;
+    if (record.revision < lastRev) backwards++;
+    lastRev = record.revision;
+  }
+  printf("  %u updates, %u cycles, %zu delivered, %ld lost, %ld incomplete, %ld torn, %ld out of order\n",
+         UPDATES, produced, delivered.size(), lost, incomplete, torn.load(), backwards);
+  CHECK(delivered.size() == produced);
+  CHECK(lost == 0);
+  CHECK(incomplete == 0);
+  CHECK(torn.load() == 0);
+  CHECK(backwards == 0);
+  CHECK(rejected.load() == 0);
+  CHECK(produced > UPDATES / 10);                  // sampling kept going meanwhile
+  CHECK(store.revision() == UPDATES);
+
+  ConfigStore restored;
+  restored.begin();
+  CHECK(restored.revision() == UPDATES);           // last update reached NVS
+}
+
+int main() {
+  RUN(testDefaultsAreValid);
+  RUN(testPartialUpdate);
+  RUN(testStaleRevisionRejected);
+  RUN(testBadFieldRejectsWholeUpdate);
+  RUN(testPersistAndRestore);
+  RUN(testApplyResponse);
+  RUN(testUpdatesUnderLoad);
+  return testResult();
+}